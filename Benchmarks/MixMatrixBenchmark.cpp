@@ -0,0 +1,78 @@
+/*
+ * MixMatrixBenchmark.cpp - Times MixMatrix for N x N matrices, in steady state and while ramping, driven the way
+ * LuaPluginProcessor::processBlock drives it: each host block is mixed in control-block slices
+ */
+#include "MixMatrix.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+constexpr int hostBlockSize = 512;
+constexpr int controlBlockSize = 64; // LuaPluginProcessor's default
+constexpr double secondsPerCase = 0.5;
+constexpr double sampleRate = 48000.0;
+
+// Returns nanoseconds per sample frame (all channels) spent on matrix updates and MixMatrix::process
+double timeCase(int numChannels, bool ramping) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    juce::AudioBuffer<float> input(numChannels, hostBlockSize), buffer(numChannels, hostBlockSize);
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int i = 0; i < hostBlockSize; ++i)
+            input.setSample(ch, i, distribution(random));
+
+    // Dense matrices, so every input/output pair is mixed
+    std::vector<float> gainsA(static_cast<size_t>(numChannels * numChannels)), gainsB(gainsA.size());
+    for (size_t k = 0; k < gainsA.size(); ++k) {
+        gainsA[k] = distribution(random) / static_cast<float>(numChannels);
+        gainsB[k] = distribution(random) / static_cast<float>(numChannels);
+    }
+
+    MixMatrix matrix;
+    matrix.prepare(numChannels, numChannels, gainsA);
+    matrix.setRampLength(controlBlockSize);
+
+    const juce::ScopedNoDenormals noDenormals;
+    const std::chrono::nanoseconds duration { static_cast<long long>(secondsPerCase * 1.0e9) };
+    std::chrono::nanoseconds elapsed { 0 };
+    long long frames = 0;
+    bool useGainsA = false;
+    while (elapsed < duration) {
+        buffer.makeCopyOf(input, true); // fresh input each host block, outside the timed region
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int slice = 0; slice < hostBlockSize; slice += controlBlockSize) {
+            // When ramping, the script publishes a new matrix every control block, so every sample is on a ramp
+            if (ramping) {
+                matrix.publish(useGainsA ? gainsA : gainsB);
+                useGainsA = !useGainsA;
+            }
+            matrix.updateFromPublished();
+            matrix.process(buffer, slice, controlBlockSize);
+        }
+        elapsed += std::chrono::steady_clock::now() - start;
+        frames += hostBlockSize;
+    }
+    return static_cast<double>(elapsed.count()) / static_cast<double>(frames);
+}
+
+} // namespace
+
+int main() {
+    std::printf("MixMatrix, %d-sample host blocks in %d-sample control slices, dense N x N gains\n",
+                hostBlockSize, controlBlockSize);
+    std::printf("%8s %10s %14s %16s %14s\n", "channels", "mode", "ns/frame", "ns/gain-sample", "% of 48k core");
+    for (int numChannels : { 2, 8, 16, 64 }) {
+        for (bool ramping : { false, true }) {
+            const double nsPerFrame = timeCase(numChannels, ramping);
+            std::printf("%8d %10s %14.2f %16.3f %14.3f\n", numChannels, ramping ? "ramping" : "steady",
+                        nsPerFrame, nsPerFrame / static_cast<double>(numChannels * numChannels),
+                        nsPerFrame * sampleRate * 1.0e-7);
+        }
+    }
+    return 0;
+}
@@ -24,13 +24,22 @@ protected:
 
 public:
     LuaInterface() : L(nullptr), apvts(nullptr) {
-        // Initialize Lua state with proper Lua 5.3 headers
-        L = luaL_newstate();
+        // Initialize Lua state with proper Lua 5.3 headers, using a counting allocator
+        L = lua_newstate(&LuaInterface::luaAlloc, nullptr);
         if (!L) {
             juce::Logger::writeToLog("Fatal: Failed to create Lua state");
             return;
         }
+        lua_atpanic(L, &LuaInterface::luaPanic); // luaL_newstate would have installed one for us
         luaL_openlibs(L); // Open standard libraries
+
+        // Helpers for allocation-free steady state: pre-sized tables and frozen tables
+        lua_pushcfunction(L, &LuaInterface::luaNewTable);
+        lua_setglobal(L, "newTable");
+        lua_pushcfunction(L, &LuaInterface::luaFreeze);
+        lua_setglobal(L, "freeze");
+        lua_pushcfunction(L, &LuaInterface::luaThaw);
+        lua_setglobal(L, "thaw");
     }
 
     virtual ~LuaInterface() {
@@ -104,6 +113,145 @@ public:
         }
     }
 
+    bool hasLuaFunction(const char* funcName) {
+        juce::ScopedLock lock(luaLock);
+        lua_getglobal(L, funcName);
+        bool isFunction = lua_isfunction(L, -1);
+        lua_pop(L, 1);
+        return isFunction;
+    }
+
+    // Read a numeric global set by the script, e.g. configuration values
+    lua_Number getLuaGlobalNumber(const char* name, lua_Number fallback) {
+        juce::ScopedLock lock(luaLock);
+        lua_getglobal(L, name);
+        int isNumber = 0;
+        lua_Number value = lua_tonumberx(L, -1, &isNumber);
+        lua_pop(L, 1);
+        return isNumber ? value : fallback;
+    }
+
+    bool getLuaGlobalBoolean(const char* name, bool fallback) {
+        juce::ScopedLock lock(luaLock);
+        lua_getglobal(L, name);
+        bool value = lua_isnil(L, -1) ? fallback : (lua_toboolean(L, -1) != 0);
+        lua_pop(L, 1);
+        return value;
+    }
+
+    // Freeze the globals table and every plain table it holds, so that adding a key (the only table
+    // write that can allocate or rehash) raises a Lua error instead. Existing keys stay writable.
+    void freezeScriptTables() {
+        juce::ScopedLock lock(luaLock);
+        lua_pushglobaltable(L);
+        freezeTable(L, -1);
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0) {
+            if (lua_istable(L, -1))
+                freezeTable(L, -1);
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+        lua_gc(L, LUA_GCCOLLECT, 0); // Settle GC debt now rather than on the audio thread
+    }
+
+    // Undo freezeScriptTables, e.g. before running the script's prepare hook again
+    void thawScriptTables() {
+        juce::ScopedLock lock(luaLock);
+        lua_pushglobaltable(L);
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0) {
+            if (lua_istable(L, -1))
+                thawTable(L, -1);
+            lua_pop(L, 1);
+        }
+        thawTable(L, -1);
+        lua_pop(L, 1);
+    }
+
+    // Allocations made by Lua on the calling thread. Counted per thread so that Lua work done on the
+    // message thread between two audio-thread calls is not attributed to an audio block.
+    static juce::int64& luaThreadAllocationCount() {
+        static thread_local juce::int64 count = 0;
+        return count;
+    }
+
+    // lua_Alloc counting every allocation or growing reallocation made by the VM
+    static void* luaAlloc(void*, void* ptr, size_t osize, size_t nsize) {
+        if (nsize == 0) {
+            std::free(ptr);
+            return nullptr;
+        }
+        if (ptr == nullptr || nsize > osize)
+            ++luaThreadAllocationCount();
+        return std::realloc(ptr, nsize);
+    }
+
+    // Unprotected Lua error (e.g. out of memory outside lua_pcall); Lua aborts once this returns
+    static int luaPanic(lua_State* L) {
+        const char* err = lua_tostring(L, -1);
+        juce::Logger::writeToLog("Lua panic: " + juce::String(err ? err : "Unknown error"));
+        return 0;
+    }
+
+    // Static Lua C function: newTable(narray, nhash) returns a table pre-sized for its final contents
+    static int luaNewTable(lua_State* L) {
+        constexpr lua_Integer maxPresize = 1 << 24;
+        lua_Integer narray = luaL_optinteger(L, 1, 0);
+        lua_Integer nhash = luaL_optinteger(L, 2, 0);
+        luaL_argcheck(L, narray >= 0 && narray <= maxPresize, 1, "array size out of range");
+        luaL_argcheck(L, nhash >= 0 && nhash <= maxPresize, 2, "hash size out of range");
+        lua_createtable(L, static_cast<int>(narray), static_cast<int>(nhash));
+        return 1;
+    }
+
+    // Static Lua C function: freeze(t) stops new keys being added to t, returns t
+    static int luaFreeze(lua_State* L) {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        freezeTable(L, 1);
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    // Static Lua C function: thaw(t) reverses freeze(t), returns t
+    static int luaThaw(lua_State* L) {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        thawTable(L, 1);
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    static int luaFrozenNewIndex(lua_State* L) {
+        return luaL_error(L, "attempt to add key '%s' to a frozen table", luaL_tolstring(L, 2, nullptr));
+    }
+
+    // Tables that already have a metatable are left alone so script-defined behaviour is kept
+    static void freezeTable(lua_State* L, int index) {
+        index = lua_absindex(L, index);
+        if (lua_getmetatable(L, index)) {
+            lua_pop(L, 1);
+            return;
+        }
+        if (luaL_newmetatable(L, "LuaFrozenTable")) {
+            lua_pushcfunction(L, &LuaInterface::luaFrozenNewIndex);
+            lua_setfield(L, -2, "__newindex");
+        }
+        lua_setmetatable(L, index);
+    }
+
+    static void thawTable(lua_State* L, int index) {
+        index = lua_absindex(L, index);
+        if (!lua_getmetatable(L, index))
+            return;
+        luaL_getmetatable(L, "LuaFrozenTable");
+        bool frozen = lua_rawequal(L, -1, -2) != 0;
+        lua_pop(L, 2);
+        if (frozen) {
+            lua_pushnil(L);
+            lua_setmetatable(L, index);
+        }
+    }
+
     // Static Lua C function for getting parameter values
     static int luaGetParam(lua_State* L) {
         if (lua_gettop(L) < 1) {
@@ -0,0 +1,344 @@
+/*
+ * LuaTypedArray.h - Native float/int32 arrays for Lua scripts (lookup tables, wavetables)
+ *
+ * Lua usage:
+ *   local lut = TypedArray.float(128)     -- zero-initialised, 0-based indexing
+ *   lut[0] = 1.0; print(#lut, lut[0])
+ *   lut:fill(v) lut:scale(g) lut:accumulate(other [, gain]) lut:normalize([peak])
+ *   lut:lookup(pos [, wrap]) lut:lookupCubic(pos [, wrap])
+ *   TypedArray.share("name", lut)         -- publish a read-only copy to all plugin instances
+ *   local shared = TypedArray.shared("name")
+ */
+#ifndef LUATYPEDARRAY_H
+#define LUATYPEDARRAY_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+};
+
+class LuaTypedArray {
+public:
+    enum class Type { float32, int32 };
+
+    // Contiguous, SIMD-aligned element storage. Once published via TypedArray.share it is never written again,
+    // so it can be read from any number of Lua states without locking.
+    struct Storage {
+        static constexpr size_t alignment = 32;
+
+        Storage(Type t, int n) : type(t), size(n) {
+            memory.calloc(static_cast<size_t>(n) * sizeof(float) + alignment);
+            auto address = reinterpret_cast<uintptr_t>(memory.get());
+            data = reinterpret_cast<void*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+        }
+
+        float* floats() const { return static_cast<float*>(data); }
+        juce::int32* ints() const { return static_cast<juce::int32*>(data); }
+
+        double get(int i) const { return type == Type::float32 ? floats()[i] : ints()[i]; }
+        void set(int i, double v) {
+            if (type == Type::float32) floats()[i] = static_cast<float>(v);
+            else ints()[i] = juce::roundToInt(v);
+        }
+
+        const Type type;
+        const int size;
+        bool readOnly = false;
+
+    private:
+        juce::HeapBlock<char> memory;
+        void* data = nullptr;
+    };
+
+    // Register the TypedArray global and the userdata metatable with a Lua state
+    static void registerWith(lua_State* L) {
+        static const luaL_Reg methods[] = {
+            { "size", &LuaTypedArray::luaSize },
+            { "fill", &LuaTypedArray::luaFill },
+            { "scale", &LuaTypedArray::luaScale },
+            { "accumulate", &LuaTypedArray::luaAccumulate },
+            { "normalize", &LuaTypedArray::luaNormalize },
+            { "lookup", &LuaTypedArray::luaLookup },
+            { "lookupCubic", &LuaTypedArray::luaLookupCubic },
+            { "copy", &LuaTypedArray::luaCopy },
+            { "isReadOnly", &LuaTypedArray::luaIsReadOnly },
+            { nullptr, nullptr }
+        };
+        static const luaL_Reg constructors[] = {
+            { "float", &LuaTypedArray::luaNewFloat },
+            { "int", &LuaTypedArray::luaNewInt },
+            { "share", &LuaTypedArray::luaShare },
+            { "shared", &LuaTypedArray::luaShared },
+            { nullptr, nullptr }
+        };
+
+        luaL_newmetatable(L, metatableName);
+        lua_pushcfunction(L, &LuaTypedArray::luaGc);
+        lua_setfield(L, -2, "__gc");
+        lua_pushcfunction(L, &LuaTypedArray::luaSize);
+        lua_setfield(L, -2, "__len");
+        lua_pushcfunction(L, &LuaTypedArray::luaNewIndex);
+        lua_setfield(L, -2, "__newindex");
+        lua_newtable(L);
+        luaL_setfuncs(L, methods, 0);
+        lua_pushcclosure(L, &LuaTypedArray::luaIndex, 1); // methods table as upvalue
+        lua_setfield(L, -2, "__index");
+        lua_pushliteral(L, "TypedArray");
+        lua_setfield(L, -2, "__metatable"); // keep __gc out of reach of getmetatable()
+        lua_pop(L, 1);
+
+        lua_newtable(L);
+        luaL_setfuncs(L, constructors, 0);
+        lua_setglobal(L, "TypedArray");
+    }
+
+    // Fetch the storage behind a TypedArray argument, raising a Lua error for anything else
+    static Storage& check(lua_State* L, int arg) {
+        auto* handle = static_cast<Handle*>(luaL_checkudata(L, arg, metatableName));
+        if (handle->storage == nullptr)
+            luaL_error(L, "TypedArray has been finalized");
+        return *handle->storage;
+    }
+
+private:
+    static constexpr const char* metatableName = "LuaTypedArray";
+    static constexpr lua_Integer maxElements = 1 << 24;
+
+    // Lua userdata payload; several handles may point at one shared read-only Storage
+    struct Handle {
+        std::shared_ptr<Storage> storage;
+    };
+
+    static Storage& push(lua_State* L, std::shared_ptr<Storage> storage) {
+        void* memory = lua_newuserdata(L, sizeof(Handle));
+        auto* handle = new (memory) Handle { std::move(storage) };
+        luaL_setmetatable(L, metatableName);
+        return *handle->storage;
+    }
+
+    static Storage& checkWritable(lua_State* L, int arg) {
+        auto& storage = check(L, arg);
+        if (storage.readOnly)
+            luaL_error(L, "TypedArray is read-only");
+        return storage;
+    }
+
+    static std::map<juce::String, std::shared_ptr<Storage>>& sharedArrays() {
+        static std::map<juce::String, std::shared_ptr<Storage>> arrays;
+        return arrays;
+    }
+
+    static juce::CriticalSection& sharedArraysLock() {
+        static juce::CriticalSection lock;
+        return lock;
+    }
+
+    static int newArray(lua_State* L, Type type) {
+        lua_Integer n = luaL_checkinteger(L, 1);
+        luaL_argcheck(L, n >= 0 && n <= maxElements, 1, "TypedArray size out of range");
+        push(L, std::make_shared<Storage>(type, static_cast<int>(n)));
+        return 1;
+    }
+
+    static int luaNewFloat(lua_State* L) { return newArray(L, Type::float32); }
+    static int luaNewInt(lua_State* L) { return newArray(L, Type::int32); }
+
+    // Release the storage but leave an empty Handle behind, so a second call or a resurrected
+    // userdata is caught by check() instead of touching freed memory
+    static int luaGc(lua_State* L) {
+        static_cast<Handle*>(luaL_checkudata(L, 1, metatableName))->storage.reset();
+        return 0;
+    }
+
+    static int luaSize(lua_State* L) {
+        lua_pushinteger(L, check(L, 1).size);
+        return 1;
+    }
+
+    static int luaIndex(lua_State* L) {
+        auto& storage = check(L, 1);
+        if (lua_type(L, 2) == LUA_TNUMBER) {
+            int isInteger = 0;
+            lua_Integer i = lua_tointegerx(L, 2, &isInteger);
+            if (isInteger && i >= 0 && i < storage.size)
+                lua_pushnumber(L, static_cast<lua_Number>(storage.get(static_cast<int>(i))));
+            else
+                lua_pushnil(L);
+            return 1;
+        }
+        lua_pushvalue(L, 2);
+        lua_gettable(L, lua_upvalueindex(1));
+        return 1;
+    }
+
+    static int luaNewIndex(lua_State* L) {
+        auto& storage = checkWritable(L, 1);
+        int isInteger = 0;
+        lua_Integer i = lua_tointegerx(L, 2, &isInteger);
+        if (!isInteger || i < 0 || i >= storage.size)
+            return luaL_error(L, "TypedArray index out of range");
+        storage.set(static_cast<int>(i), luaL_checknumber(L, 3));
+        return 0;
+    }
+
+    static int luaFill(lua_State* L) {
+        auto& storage = checkWritable(L, 1);
+        lua_Number value = luaL_checknumber(L, 2);
+        if (storage.type == Type::float32)
+            juce::FloatVectorOperations::fill(storage.floats(), static_cast<float>(value), storage.size);
+        else
+            std::fill(storage.ints(), storage.ints() + storage.size, juce::roundToInt(value));
+        return 0;
+    }
+
+    static int luaScale(lua_State* L) {
+        auto& storage = checkWritable(L, 1);
+        lua_Number gain = luaL_checknumber(L, 2);
+        if (storage.type == Type::float32) {
+            juce::FloatVectorOperations::multiply(storage.floats(), static_cast<float>(gain), storage.size);
+        } else {
+            for (int i = 0; i < storage.size; ++i)
+                storage.ints()[i] = juce::roundToInt(storage.ints()[i] * gain);
+        }
+        return 0;
+    }
+
+    // dest += source * gain, element-wise; both arrays must be the same length
+    static int luaAccumulate(lua_State* L) {
+        auto& dest = checkWritable(L, 1);
+        auto& source = check(L, 2);
+        lua_Number gain = luaL_optnumber(L, 3, 1.0);
+        luaL_argcheck(L, source.size == dest.size, 2, "TypedArray sizes differ");
+        if (dest.type == Type::float32 && source.type == Type::float32) {
+            juce::FloatVectorOperations::addWithMultiply(dest.floats(), source.floats(), static_cast<float>(gain), dest.size);
+        } else {
+            for (int i = 0; i < dest.size; ++i)
+                dest.set(i, dest.get(i) + source.get(i) * gain);
+        }
+        return 0;
+    }
+
+    // Scale a float array so its largest magnitude equals peak (default 1); returns the previous peak
+    static int luaNormalize(lua_State* L) {
+        auto& storage = checkWritable(L, 1);
+        lua_Number peak = luaL_optnumber(L, 2, 1.0);
+        luaL_argcheck(L, storage.type == Type::float32, 1, "normalize requires a float TypedArray");
+        auto range = juce::FloatVectorOperations::findMinAndMax(storage.floats(), storage.size);
+        float previousPeak = juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+        if (previousPeak > 0.0f)
+            juce::FloatVectorOperations::multiply(storage.floats(), static_cast<float>(peak) / previousPeak, storage.size);
+        lua_pushnumber(L, previousPeak);
+        return 1;
+    }
+
+    // Map an index onto the array, either clamped to the ends (LUTs) or wrapped around (wavetables)
+    static int resolveIndex(const Storage& storage, lua_Integer i, bool wrap) {
+        if (wrap)
+            return static_cast<int>(((i % storage.size) + storage.size) % storage.size);
+        return static_cast<int>(juce::jlimit<lua_Integer>(0, storage.size - 1, i));
+    }
+
+    static double splitPosition(const Storage& storage, double position, bool wrap, lua_Integer& index) {
+        if (wrap) {
+            position = std::fmod(position, static_cast<double>(storage.size));
+            if (position < 0.0)
+                position += storage.size;
+        } else {
+            position = juce::jlimit(0.0, static_cast<double>(storage.size - 1), position);
+        }
+        index = static_cast<lua_Integer>(std::floor(position));
+        return position - static_cast<double>(index);
+    }
+
+    static int luaLookup(lua_State* L) {
+        auto& storage = check(L, 1);
+        lua_Number position = luaL_checknumber(L, 2);
+        luaL_argcheck(L, std::isfinite(position), 2, "position must be finite");
+        bool wrap = lua_toboolean(L, 3) != 0;
+        if (storage.size == 0) {
+            lua_pushnumber(L, 0.0);
+            return 1;
+        }
+        lua_Integer i = 0;
+        double frac = splitPosition(storage, position, wrap, i);
+        double y0 = storage.get(resolveIndex(storage, i, wrap));
+        double y1 = storage.get(resolveIndex(storage, i + 1, wrap));
+        lua_pushnumber(L, y0 + frac * (y1 - y0));
+        return 1;
+    }
+
+    // Catmull-Rom interpolation across the four neighbouring elements
+    static int luaLookupCubic(lua_State* L) {
+        auto& storage = check(L, 1);
+        lua_Number position = luaL_checknumber(L, 2);
+        luaL_argcheck(L, std::isfinite(position), 2, "position must be finite");
+        bool wrap = lua_toboolean(L, 3) != 0;
+        if (storage.size == 0) {
+            lua_pushnumber(L, 0.0);
+            return 1;
+        }
+        lua_Integer i = 0;
+        double frac = splitPosition(storage, position, wrap, i);
+        double ym1 = storage.get(resolveIndex(storage, i - 1, wrap));
+        double y0 = storage.get(resolveIndex(storage, i, wrap));
+        double y1 = storage.get(resolveIndex(storage, i + 1, wrap));
+        double y2 = storage.get(resolveIndex(storage, i + 2, wrap));
+        double c1 = 0.5 * (y1 - ym1);
+        double c2 = ym1 - 2.5 * y0 + 2.0 * y1 - 0.5 * y2;
+        double c3 = 0.5 * (y2 - ym1) + 1.5 * (y0 - y1);
+        lua_pushnumber(L, ((c3 * frac + c2) * frac + c1) * frac + y0);
+        return 1;
+    }
+
+    static std::shared_ptr<Storage> copyOf(const Storage& source) {
+        auto copy = std::make_shared<Storage>(source.type, source.size);
+        std::memcpy(copy->floats(), source.floats(), static_cast<size_t>(source.size) * sizeof(float));
+        return copy;
+    }
+
+    // Writable copy, e.g. to modify a shared table locally
+    static int luaCopy(lua_State* L) {
+        push(L, copyOf(check(L, 1)));
+        return 1;
+    }
+
+    static int luaIsReadOnly(lua_State* L) {
+        lua_pushboolean(L, check(L, 1).readOnly);
+        return 1;
+    }
+
+    // Publish a frozen copy under a name, visible to every plugin instance in this process
+    static int luaShare(lua_State* L) {
+        const char* name = luaL_checkstring(L, 1);
+        auto copy = copyOf(check(L, 2));
+        copy->readOnly = true;
+        const juce::ScopedLock lock(sharedArraysLock());
+        sharedArrays()[juce::String(name)] = std::move(copy);
+        return 0;
+    }
+
+    static int luaShared(lua_State* L) {
+        const char* name = luaL_checkstring(L, 1);
+        std::shared_ptr<Storage> storage;
+        {
+            const juce::ScopedLock lock(sharedArraysLock());
+            auto it = sharedArrays().find(juce::String(name));
+            if (it != sharedArrays().end())
+                storage = it->second;
+        }
+        if (storage == nullptr)
+            lua_pushnil(L);
+        else
+            push(L, std::move(storage));
+        return 1;
+    }
+};
+
+#endif // LUATYPEDARRAY_H
@@ -0,0 +1,143 @@
+/*
+ * MixMatrix.h - Outputs x inputs gain matrix applied in place to an AudioBuffer, with smoothed updates
+ */
+#ifndef MIXMATRIX_H
+#define MIXMATRIX_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+class MixMatrix {
+public:
+    // Samples mixed per pass; keeps every input and output slice of a pass resident in L1/L2 cache
+    static constexpr int cacheBlockSize = 256;
+
+    // Allocate for a channel configuration; gains are row-major, gains[output * numInputs + input].
+    // Not real-time safe, call from prepareToPlay.
+    void prepare(int numInputChannels, int numOutputChannels, const std::vector<float>& gains) {
+        numInputs = numInputChannels;
+        numOutputs = numOutputChannels;
+        current = gains;
+        current.resize(static_cast<size_t>(numInputs * numOutputs), 0.0f);
+        target = current;
+        for (auto& slot : slots)
+            slot = current;
+        backSlot = 0;
+        middleSlot = 1;
+        frontSlot = 2;
+
+        // One output row per channel plus a temporary row for ramped products
+        scratch.setSize(numOutputs + 1, cacheBlockSize);
+        setRampLength(1);
+    }
+
+    // Length of the glide applied by setTarget. Not real-time safe.
+    void setRampLength(int rampLengthSamples) {
+        rampLength = juce::jmax(1, rampLengthSamples);
+        ramp.resize(static_cast<size_t>(rampLength));
+        for (int i = 0; i < rampLength; ++i)
+            ramp[static_cast<size_t>(i)] = static_cast<float>(i + 1) / static_cast<float>(rampLength);
+        rampPosition = rampLength;
+    }
+
+    // Glide from the gains in effect now to new ones over the ramp length. Real-time safe.
+    void setTarget(const std::vector<float>& gains) {
+        jassert(gains.size() == target.size());
+        if (rampPosition > 0 && rampPosition < rampLength) {
+            const float progress = ramp[static_cast<size_t>(rampPosition - 1)];
+            for (size_t k = 0; k < current.size(); ++k)
+                current[k] += (target[k] - current[k]) * progress;
+        }
+        std::copy(gains.begin(), gains.end(), target.begin());
+        rampPosition = 0;
+    }
+
+    // Hand new gains to the audio thread without locking, through a triple buffer: the writer fills its own
+    // slot and swaps it with the middle one. Calls must be serialised with each other, not with the audio thread.
+    void publish(const std::vector<float>& gains) {
+        auto& slot = slots[static_cast<size_t>(backSlot)];
+        jassert(gains.size() == slot.size());
+        std::copy(gains.begin(), gains.end(), slot.begin());
+        backSlot = middleSlot.exchange(backSlot | newDataFlag, std::memory_order_acq_rel) & slotIndexMask;
+    }
+
+    // Audio thread: glide towards the most recently published gains, if any arrived since the last call
+    void updateFromPublished() {
+        if ((middleSlot.load(std::memory_order_acquire) & newDataFlag) == 0)
+            return;
+        frontSlot = middleSlot.exchange(frontSlot, std::memory_order_acq_rel) & slotIndexMask;
+        setTarget(slots[static_cast<size_t>(frontSlot)]);
+    }
+
+    // Jump straight to the target gains
+    void finishRamp() {
+        std::copy(target.begin(), target.end(), current.begin());
+        rampPosition = rampLength;
+    }
+
+    // Mix inputs (buffer channels 0..numInputs-1) into outputs (buffer channels 0..numOutputs-1) in place
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) {
+        jassert(buffer.getNumChannels() >= juce::jmax(numInputs, numOutputs));
+        float* temp = scratch.getWritePointer(numOutputs);
+        const int endSample = startSample + numSamples;
+
+        for (int blockStart = startSample; blockStart < endSample; blockStart += cacheBlockSize) {
+            const int length = juce::jmin(cacheBlockSize, endSample - blockStart);
+            const bool ramping = rampPosition < rampLength;
+            const int rampSamples = ramping ? juce::jmin(length, rampLength - rampPosition) : 0;
+            const float* rampGains = ramp.data() + rampPosition;
+
+            for (int out = 0; out < numOutputs; ++out) {
+                float* mix = scratch.getWritePointer(out);
+                juce::FloatVectorOperations::clear(mix, length);
+
+                for (int in = 0; in < numInputs; ++in) {
+                    const size_t k = static_cast<size_t>(out * numInputs + in);
+                    const float from = current[k];
+                    const float to = target[k];
+                    const float* source = buffer.getReadPointer(in, blockStart);
+
+                    if (rampSamples == 0 || juce::exactlyEqual(from, to)) {
+                        if (! juce::exactlyEqual(to, 0.0f))
+                            juce::FloatVectorOperations::addWithMultiply(mix, source, to, length);
+                        continue;
+                    }
+
+                    // gain(n) = from + (to - from) * ramp[n] while ramping, then to
+                    juce::FloatVectorOperations::multiply(temp, source, rampGains, rampSamples);
+                    juce::FloatVectorOperations::addWithMultiply(mix, temp, to - from, rampSamples);
+                    if (! juce::exactlyEqual(from, 0.0f))
+                        juce::FloatVectorOperations::addWithMultiply(mix, source, from, rampSamples);
+                    if (length > rampSamples && ! juce::exactlyEqual(to, 0.0f))
+                        juce::FloatVectorOperations::addWithMultiply(mix + rampSamples, source + rampSamples, to, length - rampSamples);
+                }
+            }
+
+            // Every input slice of this pass has been read, so the outputs can be written back over them
+            for (int out = 0; out < numOutputs; ++out)
+                buffer.copyFrom(out, blockStart, scratch, out, 0, length);
+
+            if (ramping) {
+                rampPosition += rampSamples;
+                if (rampPosition >= rampLength)
+                    finishRamp();
+            }
+        }
+    }
+
+private:
+    int numInputs = 0, numOutputs = 0;
+    std::vector<float> current, target;
+
+    static constexpr int newDataFlag = 4, slotIndexMask = 3;
+    std::array<std::vector<float>, 3> slots;
+    int backSlot = 0, frontSlot = 2;         // owned by the publishing side and the audio thread respectively
+    std::atomic<int> middleSlot { 1 };        // slot index, plus newDataFlag when it holds unread gains
+    std::vector<float> ramp;
+    int rampLength = 1, rampPosition = 1;
+    juce::AudioBuffer<float> scratch;
+};
+
+#endif // MIXMATRIX_H
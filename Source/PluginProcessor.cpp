@@ -3,6 +3,7 @@
  */
 #include "PluginProcessor.h"
 #include "PluginEditor.h" // Assuming this exists
+#include "LuaTypedArray.h"
 
 using namespace juce;
 
@@ -10,19 +11,15 @@ static const int PARAMETER_V1 = 1;
 
 LuaPluginProcessor::LuaPluginProcessor()
         : AudioProcessor(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo())
+                                 .withInput("Sidechain", juce::AudioChannelSet::stereo(), false)
                                  .withOutput("Output", juce::AudioChannelSet::stereo())),
           apvts(*this, nullptr, "PARAMETERS", {
                   std::make_unique<juce::AudioParameterInt>(ParameterID {"volume", PARAMETER_V1}, "Volume", 0, 127, 100),
                   std::make_unique<juce::AudioParameterInt>(ParameterID {"channel", PARAMETER_V1}, "Channel", 0, 127, 0)
           })
 {
-    L = luaL_newstate();
     if (!L)
-    {
-        juce::Logger::writeToLog("Fatal: Failed to create Lua state");
-        return;
-    }
-    luaL_openlibs(L);
+        return; // LuaInterface has already logged the failure
 
     {
         juce::ScopedLock lock(luaLock); // Protect Lua initialization
@@ -34,9 +31,21 @@ LuaPluginProcessor::LuaPluginProcessor()
         lua_pushcfunction(L, luaSetParam);
         lua_setglobal(L, "setParam");
 
+        lua_pushcfunction(L, luaGetNumInputChannels);
+        lua_setglobal(L, "getNumInputChannels");
+        lua_pushcfunction(L, luaGetNumOutputChannels);
+        lua_setglobal(L, "getNumOutputChannels");
+        lua_pushcfunction(L, luaSetMixGain);
+        lua_setglobal(L, "setMixGain");
+        lua_pushcfunction(L, luaSetMixMatrix);
+        lua_setglobal(L, "setMixMatrix");
+
+        LuaTypedArray::registerWith(L);
+
         if (luaL_dostring(L, R"(
+			controlBlockSize = 64
 			lastVol = 0
-			lutTrans = {}
+			lutTrans = TypedArray.float(128)
 			for i = 0, 127 do
 				lutTrans[i] = i / 127
 			end
@@ -49,7 +58,11 @@ LuaPluginProcessor::LuaPluginProcessor()
 				end
             end
 
-            function processBlockEnter(numSamples)
+            function prepare(sampleRate, blockSize, numChannels)
+                print("lua:prepare " .. sampleRate .. " Hz, " .. blockSize .. " samples, " .. numChannels .. " channels")
+            end
+
+            function processControl(numSamples)
                 local vol = getParam("volume")
 				if (vol ~= lastVol) then
                 	print("lua:Processing block with volume: " .. vol)
@@ -77,6 +90,7 @@ LuaPluginProcessor::LuaPluginProcessor()
 }
 
 LuaPluginProcessor::~LuaPluginProcessor() {
+    stopTimer();
     apvts.removeParameterListener("volume", this);
     apvts.removeParameterListener("channel", this);
 }
@@ -103,12 +117,78 @@ void LuaPluginProcessor::parameterGestureChanged(int parameterIndex, bool gestur
 
 void LuaPluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
     juce::Logger::writeToLog("prepareToPlay called with sampleRate: " + String(sampleRate) + ", blockSize: " + String(samplesPerBlock));
+
+    // Run the script's one-off setup here, off the audio thread, then freeze what it built
+    scriptFrozen = false;
+    thawScriptTables();
+
+    // Default routing passes each main input straight through; side-chain inputs start muted
+    {
+        juce::ScopedLock lock(luaLock);
+        numMixInputs = getTotalNumInputChannels();
+        numMixOutputs = getTotalNumOutputChannels();
+        pendingMixGains.assign(static_cast<size_t>(numMixInputs * numMixOutputs), 0.0f);
+        for (int ch = 0; ch < jmin(getMainBusNumInputChannels(), numMixOutputs); ++ch)
+            pendingMixGains[static_cast<size_t>(ch * numMixInputs + ch)] = 1.0f;
+        mixMatrix.prepare(numMixInputs, numMixOutputs, pendingMixGains);
+    }
+
+    callLuaFunction("prepare", 3, sampleRate, static_cast<double>(samplesPerBlock),
+                    static_cast<double>(getTotalNumOutputChannels()));
+    // Clamp before converting: the script may have set anything, including NaN or math.huge
+    const lua_Number requestedControlBlockSize = getLuaGlobalNumber("controlBlockSize", defaultControlBlockSize);
+    controlBlockSize = std::isnan(requestedControlBlockSize)
+                           ? defaultControlBlockSize
+                           : static_cast<int>(jlimit<lua_Number>(1, maxControlBlockSize, requestedControlBlockSize));
+    hasProcessBlockEnter = hasLuaFunction("processBlockEnter");
+    hasProcessControl = hasLuaFunction("processControl");
+    hasMidiEvent = hasLuaFunction("midiEvent");
+    hasProcessBlockExit = hasLuaFunction("processBlockExit");
+
+    mixMatrix.setRampLength(controlBlockSize);
+
+    warmUpScript(samplesPerBlock);
+    samplesUntilControlTick = 0;
+    mixMatrix.finishRamp();
+    freezeScriptTables();
+    verifyAllocations = getLuaGlobalBoolean("verifyAllocations", false);
+    lastBlockAllocations = 0;
+    maxBlockAllocations = 0;
+    allocatingBlocks = 0;
+    reportedAllocatingBlocks = 0;
+    if (verifyAllocations)
+        startTimer(1000);
+    else
+        stopTimer();
+    scriptFrozen = true;
+}
+
+void LuaPluginProcessor::warmUpScript(int samplesPerBlock) {
+    // Run the block callbacks on silence so lazily-created script state exists before real audio arrives
+    juce::AudioBuffer<float> silence(jmax(1, getTotalNumInputChannels(), getTotalNumOutputChannels()), jmax(1, samplesPerBlock));
+    juce::MidiBuffer midi;
+    for (int i = 0; i < warmUpBlocks; ++i)
+    {
+        silence.clear();
+        processBlock(silence, midi);
+    }
 }
 
 void LuaPluginProcessor::releaseResources() {
     juce::Logger::writeToLog("releaseResources called");
 }
 
+// Report allocation verification results from the message thread, so the audio thread never logs
+void LuaPluginProcessor::timerCallback() {
+    const auto blocks = allocatingBlocks.load();
+    if (blocks == reportedAllocatingBlocks)
+        return;
+    juce::Logger::writeToLog("Lua allocated in " + String(blocks - reportedAllocatingBlocks)
+                             + " blocks after freeze (last allocating block: " + String(lastBlockAllocations.load())
+                             + ", max per block: " + String(maxBlockAllocations.load()) + ")");
+    reportedAllocatingBlocks = blocks;
+}
+
 void LuaPluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
 {
     // !J! For testing only:
@@ -129,14 +209,159 @@ void LuaPluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
     }
 #endif
 
-    callLuaFunction("processBlockEnter", 1, buffer.getNumSamples());
+    const auto allocationsBefore = luaThreadAllocationCount();
+
+    const int numSamples = buffer.getNumSamples();
+
+    if (hasProcessBlockEnter)
+        callLuaFunction("processBlockEnter", 1, static_cast<double>(numSamples));
+
+    // Walk the buffer on a fixed control-rate grid, independent of the host block size.
+    // A control block cut short by the end of this buffer carries over into the next one.
+    auto midiIterator = midi.cbegin();
+    for (int start = 0; start < numSamples;)
+    {
+        const bool startsControlBlock = samplesUntilControlTick == 0;
+        if (startsControlBlock)
+            samplesUntilControlTick = controlBlockSize;
+
+        const int length = jmin(numSamples - start, samplesUntilControlTick);
+        const int controlOffset = controlBlockSize - samplesUntilControlTick;
+
+        // MIDI is delivered with positions relative to the start of its control block
+        for (; midiIterator != midi.cend() && (*midiIterator).samplePosition < start + length; ++midiIterator)
+        {
+            if (!hasMidiEvent)
+                continue;
+            const auto event = *midiIterator;
+            callLuaFunction("midiEvent", 4,
+                            static_cast<double>(event.data[0]),
+                            static_cast<double>(event.numBytes > 1 ? event.data[1] : 0),
+                            static_cast<double>(event.numBytes > 2 ? event.data[2] : 0),
+                            static_cast<double>(controlOffset + event.samplePosition - start));
+        }
+
+        if (startsControlBlock)
+        {
+            if (hasProcessControl)
+                callLuaFunction("processControl", 1, static_cast<double>(controlBlockSize));
+            controlGain = apvts.getRawParameterValue("volume")->load() / 127.0f;
+            mixMatrix.updateFromPublished(); // Matrix changes made by the script since the last control block
+        }
+
+        mixMatrix.process(buffer, start, length);
+
+        for (int ch = 0; ch < getTotalNumOutputChannels(); ++ch)
+            buffer.applyGain(ch, start, length, controlGain);
+
+        start += length;
+        samplesUntilControlTick -= length;
+    }
+
+    if (hasProcessBlockExit)
+        callLuaFunction("processBlockExit", 1, static_cast<double>(numSamples));
+
+    if (verifyAllocations && scriptFrozen)
+    {
+        const auto allocations = luaThreadAllocationCount() - allocationsBefore;
+        if (allocations > 0)
+        {
+            lastBlockAllocations = allocations;
+            if (allocations > maxBlockAllocations.load(std::memory_order_relaxed))
+                maxBlockAllocations = allocations; // audio thread is the only writer
+            ++allocatingBlocks;
+        }
+    }
+}
+
+bool LuaPluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+    // Any channel count on the main buses (output must be enabled), plus an optional side-chain
+    const auto mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput.isDisabled() || mainOutput.size() > maxBusChannels)
+        return false;
+    if (layouts.getMainInputChannelSet().size() > maxBusChannels)
+        return false;
+    if (layouts.inputBuses.size() > 1 && layouts.getChannelSet(true, 1).size() > maxBusChannels)
+        return false;
+    return true;
+}
+
+LuaPluginProcessor* LuaPluginProcessor::getProcessorFromLua(lua_State* L)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, "LuaPluginProcessor");
+    auto* processor = static_cast<LuaPluginProcessor*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    if (!processor)
+        luaL_error(L, "LuaPluginProcessor instance not found in registry");
+    return processor;
+}
+
+int LuaPluginProcessor::luaGetNumInputChannels(lua_State* L)
+{
+    lua_pushinteger(L, getProcessorFromLua(L)->numMixInputs);
+    return 1;
+}
+
+int LuaPluginProcessor::luaGetNumOutputChannels(lua_State* L)
+{
+    lua_pushinteger(L, getProcessorFromLua(L)->numMixOutputs);
+    return 1;
+}
 
-    float vol = apvts.getRawParameterValue("volume")->load() / 127.0f;
+// setMixGain(output, input, gain), 0-based channel indices; takes effect at the next control block
+int LuaPluginProcessor::luaSetMixGain(lua_State* L)
+{
+    auto* processor = getProcessorFromLua(L);
+    lua_Integer output = luaL_checkinteger(L, 1);
+    lua_Integer input = luaL_checkinteger(L, 2);
+    lua_Number gain = luaL_checknumber(L, 3);
+    luaL_argcheck(L, output >= 0 && output < processor->numMixOutputs, 1, "output channel out of range");
+    luaL_argcheck(L, input >= 0 && input < processor->numMixInputs, 2, "input channel out of range");
+
+    juce::ScopedLock lock(processor->luaLock);
+    processor->pendingMixGains[static_cast<size_t>(output * processor->numMixInputs + input)] = static_cast<float>(gain);
+    processor->mixMatrix.publish(processor->pendingMixGains);
+    return 0;
+}
+
+// setMixMatrix(gains) with outputs x inputs gains in row-major order, as a float TypedArray or a Lua sequence
+int LuaPluginProcessor::luaSetMixMatrix(lua_State* L)
+{
+    auto* processor = getProcessorFromLua(L);
+    const auto numGains = static_cast<lua_Integer>(processor->pendingMixGains.size());
+
+    // Validate everything first: a Lua error would skip the ScopedLock destructor
+    if (lua_istable(L, 1))
+    {
+        luaL_argcheck(L, static_cast<lua_Integer>(lua_rawlen(L, 1)) == numGains, 1, "expected outputs x inputs gains");
+        for (lua_Integer k = 1; k <= numGains; ++k)
+        {
+            lua_rawgeti(L, 1, k);
+            luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+        }
 
-    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-        buffer.applyGain(ch, 0, buffer.getNumSamples(), vol);
+        juce::ScopedLock lock(processor->luaLock);
+        for (lua_Integer k = 0; k < numGains; ++k)
+        {
+            lua_rawgeti(L, 1, k + 1);
+            processor->pendingMixGains[static_cast<size_t>(k)] = static_cast<float>(lua_tonumber(L, -1));
+            lua_pop(L, 1);
+        }
+        processor->mixMatrix.publish(processor->pendingMixGains);
+    }
+    else
+    {
+        auto& gains = LuaTypedArray::check(L, 1);
+        luaL_argcheck(L, gains.size == numGains, 1, "expected outputs x inputs gains");
 
-    callLuaFunction("processBlockExit", 1, buffer.getNumSamples());
+        juce::ScopedLock lock(processor->luaLock);
+        for (int k = 0; k < gains.size; ++k)
+            processor->pendingMixGains[static_cast<size_t>(k)] = static_cast<float>(gains.get(k));
+        processor->mixMatrix.publish(processor->pendingMixGains);
+    }
+    return 0;
 }
 
 void LuaPluginProcessor::getStateInformation(juce::MemoryBlock& destData)
@@ -6,11 +6,13 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "LuaInterface.h"
+#include "MixMatrix.h"
 
 class LuaPluginProcessor : public juce::AudioProcessor,
                            public LuaInterface,
                            public juce::AudioProcessorValueTreeState::Listener,
-                           public juce::AudioProcessorParameter::Listener {
+                           public juce::AudioProcessorParameter::Listener,
+                           private juce::Timer {
 public:
     LuaPluginProcessor();
     ~LuaPluginProcessor() override;
@@ -27,6 +29,7 @@ public:
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
     void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override;
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
     const juce::String getName() const override;
     bool acceptsMidi() const override;
     bool producesMidi() const override;
@@ -53,9 +56,44 @@ public:
     juce::String getLuaScript() const;
 
 private:
+    void warmUpScript(int samplesPerBlock);
+    void timerCallback() override;
+
+    // Lua C functions for the routing matrix
+    static LuaPluginProcessor* getProcessorFromLua(lua_State* L);
+    static int luaGetNumInputChannels(lua_State* L);
+    static int luaGetNumOutputChannels(lua_State* L);
+    static int luaSetMixGain(lua_State* L);
+    static int luaSetMixMatrix(lua_State* L);
+
     juce::AudioProcessorValueTreeState apvts;
     static const juce::String defaultLuaScript;
 
+    static constexpr int warmUpBlocks = 4;
+    static constexpr int defaultControlBlockSize = 64;
+    static constexpr int maxControlBlockSize = 4096;
+
+    // Control-rate scheduling, configured from the script's controlBlockSize global in prepareToPlay
+    int controlBlockSize = defaultControlBlockSize;
+    int samplesUntilControlTick = 0;
+    float controlGain = 0.0f;
+    bool hasProcessBlockEnter = false, hasProcessControl = false, hasMidiEvent = false, hasProcessBlockExit = false;
+
+    // Routing matrix over all input channels (main then side-chain) to all output channels.
+    // Scripts edit pendingMixGains under luaLock and publish a copy to mixMatrix, which the audio thread
+    // picks up lock-free at the next control block.
+    static constexpr int maxBusChannels = 64;
+    MixMatrix mixMatrix;
+    int numMixInputs = 0, numMixOutputs = 0;
+    std::vector<float> pendingMixGains;
+
+    std::atomic<bool> scriptFrozen { false };
+    bool verifyAllocations = false;
+
+    // Allocation verification results, written by the audio thread and reported by timerCallback
+    std::atomic<juce::int64> lastBlockAllocations { 0 }, maxBlockAllocations { 0 }, allocatingBlocks { 0 };
+    juce::int64 reportedAllocatingBlocks = 0;
+
 };
 
 #endif // PLUGINPROCESSOR_H
\ No newline at end of file